@@ -17,6 +17,9 @@
 #include <string>
 #include <cstring>
 #include <cctype>
+#include <map>
+#include <sstream>
+#include <utility>
 #include <boost/format.hpp>
 
 #include "VecFunc.hpp"
@@ -49,6 +52,21 @@ class Puzzle{
         // Get the width of board and read accepted input chars
         int readDim(fstream& fs);
 
+        // Reads the optional variant constraints that follow the grid
+        void readConstraints(istream&);
+
+        // Adds both main diagonals as units (X-Sudoku)
+        void addDiagonals(void);
+
+        // Replaces the square boxes with the given region id per cell
+        // (jigsaw). Returns false unless every region has dimension cells
+        bool setRegions(vector<int> ids);
+
+        // Adds a killer cage: distinct values at the (row,col) cells
+        // that sum to the given total. Returns false on cells that are
+        // out of range, repeated, or already in another cage
+        bool addCage(int sum, vector<pair<int,int>> cells);
+
         // Determines if a vector only contains only unique vals
         // Skips appropriate empty cell value (i.e. '0' or 0)
         bool isunique(vector<T>);
@@ -59,23 +77,28 @@ class Puzzle{
         // Interact with the game board
         void play(void);
 
-        // Use isunique to determine if a board is solved
+        // Determine if the board is full and satisfies every unit and cage
         bool victory(void);
 
-        // Solve the puzzle (returns false if unsolveable)
+        // Solve the puzzle (returns false if unsolveable or if the
+        // board's constraints failed to load)
         bool solve(void);
 
         // Determine if elem is already present in the sub grid
-        // containing (x,y)
+        // (3x3 box or jigsaw region) containing (x,y)
         bool check3x3(T elem, int x, int y);
 
-        // Runs all three logic checks on the correctness of elem at (x,y)
+        // Determine if elem is already present in any unit or cage
+        // containing (x,y)
         bool checkpos(T elem, int x, int y);
 
         // Return the row or column at given index
         vector<T> getRow(int index);
         vector<T> getCol(int index);
 
+        // Legacy utilities from the scanning solver; solve() no longer
+        // uses them, but they still work on every variant via checkpos
+
         // Takes a 3D vector of possible values and places all singletons
         // Returns false if no values placed
         bool placeSingletons(vector<vector<vector<T>>>&);
@@ -85,6 +108,22 @@ class Puzzle{
 
     private:
 
+        // Candidate values of a cell, one bit per index into legalvals
+        typedef unsigned long long mask_t;
+
+        // Rebuilds the flat unit and peer tables from the constraints.
+        // Called lazily by the functions that read the tables
+        void buildUnits(void);
+
+        // Index of val in legalvals, or -1 for an empty cell
+        int valIndex(T val);
+
+        // Solver helpers working on a candidate mask and value index
+        // per cell. Each returns false on a contradiction
+        bool place(vector<mask_t>& cand, vector<int>& vals, int cell, int v);
+        bool propagate(vector<mask_t>& cand, vector<int>& vals);
+        bool search(vector<mask_t>& cand, vector<int>& vals);
+
         // Contains the data of the puzzle; 0's represent empty cells
         vector<vector<T>> board;
 
@@ -100,6 +139,28 @@ class Puzzle{
         // In interactive mode, allow/ban entering element already present
         // in row/col/sub grid. Default false
         bool allowDups{false};
+
+        // Region id of each cell (row * dimension + col); -1 if none
+        vector<int> regions;
+
+        // Whether the diagonals are units (X-Sudoku)
+        bool diagonals{false};
+
+        // Cleared when the grid or a constraint in the board file is
+        // rejected
+        bool valid{true};
+
+        // Set when the constraints changed since the last buildUnits()
+        bool stale{true};
+
+        // Killer cages: cells of cage k are
+        // cagecells[cagestart[k]] .. cagecells[cagestart[k + 1] - 1]
+        vector<int> cagecells, cagestart{0}, cagesums;
+
+        // Units (rows, cols, regions, diagonals) and the peers of each
+        // cell, flattened the same way as the cages
+        vector<int> unitcells, unitstart;
+        vector<int> peercells, peerstart;
 };
 
 //==========================================//
@@ -153,7 +214,11 @@ istream& operator>>(istream& stream, Puzzle<T>& puzzle){
     for(int i = 0; i < puzzle.dimension; i++){
         for(int j = 0; j < puzzle.dimension; j++){
 
-            stream >> data; //collect stream value
+            // A short or malformed grid leaves the puzzle unsolvable
+            if(!(stream >> data)){
+                puzzle.valid = false;
+                return stream;
+            }
             puzzle.board[i][j] = data; //write to board
 
             // For first cell, check character type and set 'word' boolean
@@ -172,12 +237,14 @@ istream& operator>>(istream& stream, Puzzle<T>& puzzle){
 template<typename T>
 Puzzle<T>::Puzzle(int dim_in){
     dimension = dim_in;
+    word = false;
     T default_val = 0;
     for(int i = 0; i < dimension; i++){
         vector<T> tmp;
         board.push_back(tmp);
         for(int j = 0; j < dimension; j++)
             board[i].push_back(default_val);
+        legalvals.push_back(i + 1);
     }
 }
 
@@ -188,6 +255,8 @@ Puzzle<T>::Puzzle(fstream& fs){
     // Open streams should be given to 3rd constructor
     if(!fs.is_open()){
         cout << "Error: constructor requires open fstream\n";
+        dimension = 0;
+        valid = false;
         return;
     }
 
@@ -203,8 +272,9 @@ Puzzle<T>::Puzzle(fstream& fs){
             board[i].push_back(default_val);
     }
 
-    // Read file data
+    // Read file data and any variant constraints
     fs >> (*this);
+    if(valid) readConstraints(fs);
 }
 
 // Third constructor: takes filename as string
@@ -215,6 +285,7 @@ Puzzle<T>::Puzzle(string fname){
     fstream fs;
     fs.open(fname.c_str(), fstream::in);
     dimension = readDim(fs);
+    if(!fs.is_open() || dimension < 1) valid = false;
     if(!word){
         fs.close();
         fs.open(fname.c_str(), fstream::in);
@@ -229,8 +300,9 @@ Puzzle<T>::Puzzle(string fname){
             board[i].push_back(default_val);
     }
 
-    // Read file data and close stream
+    // Read file data and any variant constraints, then close stream
     fs >> (*this);
+    if(valid) readConstraints(fs);
     fs.close();
 }
 
@@ -249,6 +321,202 @@ int Puzzle<T>::readDim(fstream& fs){
     return result;
 }
 
+// Reads variant constraints from the lines following the grid:
+//   diagonals              - X-Sudoku, both diagonals are units
+//   regions                - jigsaw, followed by a label for every cell
+//   cage <sum> <r,c> ...   - killer cage over 1-based (row,col) cells
+// A bad constraint stops the load and leaves the puzzle unsolvable
+template<typename T>
+void Puzzle<T>::readConstraints(istream& stream){
+    string keyword;
+    while(stream >> keyword){
+        if(keyword == "diagonals"){
+            addDiagonals();
+        }else if(keyword == "regions"){
+            // Labels may be any token; number them in order of appearance
+            map<string, int> labels;
+            vector<int> ids;
+            string label;
+            for(int i = 0; i < dimension * dimension && stream >> label; i++){
+                if(labels.find(label) == labels.end()){
+                    int id = labels.size();
+                    labels[label] = id;
+                }
+                ids.push_back(labels[label]);
+            }
+            if(!setRegions(ids)){
+                cout << boost::format("Error: every region needs exactly %d cells\n") % dimension;
+                valid = false;
+                return;
+            }
+        }else if(keyword == "cage"){
+            int sum = 0, row, col;
+            char comma;
+            string rest;
+            vector<pair<int,int>> cells;
+            bool parsed = true;
+            if(!(stream >> sum)) parsed = false;
+            getline(stream, rest);
+            istringstream ss(rest);
+            while(parsed && ss >> row >> comma >> col){
+                if(comma != ',') parsed = false;
+                cells.push_back(make_pair(row - 1, col - 1));
+            }
+
+            // Every token must be a row,col pair, up to the end of the line
+            if(!ss.eof()) parsed = false;
+            if(!parsed || !addCage(sum, cells)){
+                cout << boost::format("Error: bad cage with sum %d\n") % sum;
+                valid = false;
+                return;
+            }
+        }else{
+            cout << boost::format("Error: unknown constraint '%s'\n") % keyword;
+            valid = false;
+            return;
+        }
+    }
+}
+
+template<typename T>
+void Puzzle<T>::addDiagonals(void){
+    diagonals = true;
+    stale = true;
+}
+
+template<typename T>
+bool Puzzle<T>::setRegions(vector<int> ids){
+    if((int)ids.size() != dimension * dimension) return false;
+
+    // Renumber the ids to 0..dimension-1 and count the cells of each
+    map<int, int> renum;
+    vector<int> sizes;
+    for(unsigned int i = 0; i < ids.size(); i++){
+        if(renum.find(ids[i]) == renum.end()){
+            int id = renum.size();
+            renum[ids[i]] = id;
+            sizes.push_back(0);
+        }
+        ids[i] = renum[ids[i]];
+        sizes[ids[i]]++;
+    }
+    for(unsigned int i = 0; i < sizes.size(); i++)
+        if(sizes[i] != dimension) return false;
+
+    regions = ids;
+    stale = true;
+    return true;
+}
+
+template<typename T>
+bool Puzzle<T>::addCage(int sum, vector<pair<int,int>> cells){
+    if(cells.empty() || (int)cells.size() > dimension) return false;
+    for(unsigned int i = 0; i < cells.size(); i++)
+        if(cells[i].first < 0 || cells[i].first >= dimension ||
+           cells[i].second < 0 || cells[i].second >= dimension)
+            return false;
+
+    // Each cell may appear once, in at most one cage
+    for(unsigned int i = 0; i < cells.size(); i++){
+        int cell = cells[i].first * dimension + cells[i].second;
+        for(unsigned int j = 0; j < i; j++)
+            if(cells[j] == cells[i]) return false;
+        for(unsigned int j = 0; j < cagecells.size(); j++)
+            if(cagecells[j] == cell) return false;
+    }
+
+    for(unsigned int i = 0; i < cells.size(); i++)
+        cagecells.push_back(cells[i].first * dimension + cells[i].second);
+    cagestart.push_back(cagecells.size());
+    cagesums.push_back(sum);
+    stale = true;
+    return true;
+}
+
+// Flattens every unit and the peers of every cell into index tables
+// so the solver never has to work out row/col/region geometry itself
+template<typename T>
+void Puzzle<T>::buildUnits(void){
+    int ncells = dimension * dimension;
+
+    // Without jigsaw regions, use square boxes when the dimension allows
+    if((int)regions.size() != ncells){
+        regions.assign(ncells, -1);
+        int box = 1;
+        while((box + 1) * (box + 1) <= dimension) box++;
+        if(box * box == dimension)
+            for(int i = 0; i < ncells; i++)
+                regions[i] = (i / dimension / box) * box + (i % dimension) / box;
+    }
+
+    vector<vector<int>> units;
+    for(int i = 0; i < dimension; i++){
+        vector<int> row, col, reg;
+        for(int j = 0; j < dimension; j++){
+            row.push_back(i * dimension + j);
+            col.push_back(j * dimension + i);
+        }
+        for(int c = 0; c < ncells; c++)
+            if(regions[c] == i) reg.push_back(c);
+        units.push_back(row);
+        units.push_back(col);
+        if(!reg.empty()) units.push_back(reg);
+    }
+    if(diagonals){
+        vector<int> diag, anti;
+        for(int i = 0; i < dimension; i++){
+            diag.push_back(i * dimension + i);
+            anti.push_back(i * dimension + dimension - 1 - i);
+        }
+        units.push_back(diag);
+        units.push_back(anti);
+    }
+
+    unitcells.clear();
+    unitstart.assign(1, 0);
+    for(unsigned int u = 0; u < units.size(); u++){
+        unitcells.insert(unitcells.end(), units[u].begin(), units[u].end());
+        unitstart.push_back(unitcells.size());
+    }
+
+    // Cages also force distinct values, so their cells are peers too
+    for(unsigned int k = 0; k + 1 < cagestart.size(); k++)
+        units.push_back(vector<int>(cagecells.begin() + cagestart[k],
+                                    cagecells.begin() + cagestart[k + 1]));
+
+    vector<vector<int>> cellunits(ncells);
+    for(unsigned int u = 0; u < units.size(); u++)
+        for(unsigned int i = 0; i < units[u].size(); i++)
+            cellunits[units[u][i]].push_back(u);
+
+    peercells.clear();
+    peerstart.assign(1, 0);
+    vector<bool> seen(ncells, false);
+    for(int c = 0; c < ncells; c++){
+        int first = peercells.size();
+        for(unsigned int u = 0; u < cellunits[c].size(); u++){
+            vector<int>& unit = units[cellunits[c][u]];
+            for(unsigned int i = 0; i < unit.size(); i++)
+                if(unit[i] != c && !seen[unit[i]]){
+                    seen[unit[i]] = true;
+                    peercells.push_back(unit[i]);
+                }
+        }
+        for(unsigned int p = first; p < peercells.size(); p++)
+            seen[peercells[p]] = false;
+        peerstart.push_back(peercells.size());
+    }
+
+    stale = false;
+}
+
+template<typename T>
+int Puzzle<T>::valIndex(T val){
+    for(int v = 0; v < dimension && v < (int)legalvals.size(); v++)
+        if(legalvals[v] == val) return v;
+    return -1;
+}
+
 // Determines whether or not a vector has duplicated values
 // Poor time complexity, yes, but excellent space complexity
 template<typename T>
@@ -264,89 +532,161 @@ bool Puzzle<T>::isunique(vector<T> vec_in){
     return true;
 }
 
-// Solve the puzzle
+// Solve the puzzle: propagate candidates through the unit and cage
+// tables, then search on the cell with the fewest candidates left
 template<typename T>
 bool Puzzle<T>::solve(void){
+    int ncells = dimension * dimension;
+    if(!valid || dimension < 1 || dimension > 64 || (int)legalvals.size() < dimension)
+        return false;
+    if(stale) buildUnits();
+
+    mask_t full = dimension == 64 ? ~0ULL : (1ULL << dimension) - 1;
+    vector<mask_t> cand(ncells, full);
+    vector<int> vals(ncells, -1);
+
+    // Place the givens
+    for(int i = 0; i < ncells; i++){
+        int v = valIndex(board[i / dimension][i % dimension]);
+        if(v >= 0 && !place(cand, vals, i, v)) return false;
+    }
 
-    // Possvals holds vectors of values that are legal at a given (x,y)
-    vector<vector<vector<T>>> possvals;
+    if(!search(cand, vals)) return false;
 
-    // Inflate possvals to have high enough dimension
-    for(int row = 0; row < dimension; row++){
-        possvals.push_back(vector<vector<T>>());
-        for(int col = 0; col < dimension; col++)
-            possvals[row].push_back(vector<T>());
+    for(int i = 0; i < ncells; i++)
+        board[i / dimension][i % dimension] = legalvals[vals[i]];
+    return true;
+}
+
+// Assign value index v to cell and strike it from the cell's peers
+template<typename T>
+bool Puzzle<T>::place(vector<mask_t>& cand, vector<int>& vals, int cell, int v){
+    mask_t bit = 1ULL << v;
+    if(!(cand[cell] & bit)) return false;
+    vals[cell] = v;
+    cand[cell] = bit;
+    for(int p = peerstart[cell]; p < peerstart[cell + 1]; p++){
+        cand[peercells[p]] &= ~bit;
+        if(!cand[peercells[p]]) return false;
     }
+    return true;
+}
 
-    // n will be used to iterate over the private vector of legal values
-    typename vector<T>::const_iterator n;
-    typename vector<T>::const_reverse_iterator r;
+// Place naked and hidden singles and prune cage candidates until
+// nothing changes
+template<typename T>
+bool Puzzle<T>::propagate(vector<mask_t>& cand, vector<int>& vals){
+    int ncells = dimension * dimension;
+    mask_t full = dimension == 64 ? ~0ULL : (1ULL << dimension) - 1;
+    bool changed = true;
+
+    while(changed){
+        changed = false;
+
+        // Naked singles: cells with one candidate left
+        for(int c = 0; c < ncells; c++)
+            if(vals[c] < 0 && __builtin_popcountll(cand[c]) == 1){
+                if(!place(cand, vals, c, __builtin_ctzll(cand[c]))) return false;
+                changed = true;
+            }
 
-    // Populate possvals: iterate over every position
-    for(int row = 0; row < dimension; row++)
-        for(int col = 0; col < dimension; col++)
-            for(n = legalvals.begin(); n != legalvals.end(); n++)
-                if(board[row][col] == 0 && checkpos(*n, row, col))
-                    possvals[row][col].push_back(*n);
-
-    // Backup the values of board
-    vector<vector<T>> backup = board;
-    do{
-        backup = board;
-        placeSingletons(possvals);
-        resetPoss(possvals);
-        typename vector<T>::const_iterator uut;
-
-        // check possvals by row
-        for(int i = 0; i < dimension; i++)
-            for(int j = 0; j < dimension; j++)
-                for(uut = possvals[i][j].begin(); uut != possvals[i][j].end(); uut++){
-                    bool only_n_in_row = true;
-                    bool only_n_in_col = true;
-                    
-                    // hold row constant
-                    for(int col = 0; col < dimension; col++){
-                        if(col == j) continue;
-                        for(unsigned int test = 0; test < possvals[i][col].size(); test++){
-                            if(possvals[i][col][test] == *uut){
-                                only_n_in_row= false;
-                                break;
-                            }
-                        }
-                        if(!only_n_in_row) break;
-                    }
-                    
-                    // hold col constant
-                    if(!only_n_in_row){//only need to do if uut wasn't uniq in row
-
-                        for(int row = 0; row < dimension; row++){
-                            if(row == i) continue;
-                            for(unsigned int test = 0; test < possvals[row][j].size(); test++){
-                                if(possvals[row][j][test] == *uut){
-                                    only_n_in_col = false;
-                                    break;
-                                }
-                            }
-                            if(!only_n_in_col) break;
-                        }
-                    }
-                    
-                    if(only_n_in_row || only_n_in_col){
-                        board[i][j] = *uut;
-                        possvals[i][j].clear();
-                        resetPoss(possvals);
-                        break; //move to next cell
+        // Hidden singles: values with one possible cell left in a unit
+        for(unsigned int u = 0; u + 1 < unitstart.size(); u++){
+            mask_t once = 0, twice = 0, placed = 0;
+            for(int i = unitstart[u]; i < unitstart[u + 1]; i++){
+                int c = unitcells[i];
+                if(vals[c] >= 0){
+                    placed |= cand[c];
+                }else{
+                    twice |= once & cand[c];
+                    once |= cand[c];
+                }
+            }
+            if((once | placed) != full) return false;
+
+            for(mask_t single = once & ~twice & ~placed; single; single &= single - 1){
+                int v = __builtin_ctzll(single), cell = -1;
+                for(int i = unitstart[u]; i < unitstart[u + 1]; i++)
+                    if(vals[unitcells[i]] < 0 && (cand[unitcells[i]] & (1ULL << v)))
+                        cell = unitcells[i];
+                if(cell < 0 || !place(cand, vals, cell, v)) return false;
+                changed = true;
+            }
+        }
+
+        // Cages: drop candidates that leave the rest of the cage unable
+        // to reach its sum. Value index v counts as v + 1
+        for(unsigned int k = 0; k < cagesums.size(); k++){
+            int need = cagesums[k], empty = 0;
+            for(int i = cagestart[k]; i < cagestart[k + 1]; i++){
+                if(vals[cagecells[i]] >= 0) need -= vals[cagecells[i]] + 1;
+                else empty++;
+            }
+            if(empty == 0){
+                if(need != 0) return false;
+                continue;
+            }
+
+            for(int i = cagestart[k]; i < cagestart[k + 1]; i++){
+                int c = cagecells[i];
+                if(vals[c] >= 0) continue;
+
+                mask_t others = 0;
+                for(int j = cagestart[k]; j < cagestart[k + 1]; j++)
+                    if(j != i && vals[cagecells[j]] < 0) others |= cand[cagecells[j]];
+
+                for(mask_t left = cand[c]; left; left &= left - 1){
+                    int v = __builtin_ctzll(left);
+                    mask_t pool = others & ~(1ULL << v);
+                    int rest = need - (v + 1), lo = 0, hi = 0, n = 0;
+
+                    // Smallest and largest sums of empty - 1 distinct values
+                    for(int w = 0; w < dimension && n < empty - 1; w++)
+                        if(pool & (1ULL << w)){ lo += w + 1; n++; }
+                    if(n == empty - 1){
+                        n = 0;
+                        for(int w = dimension - 1; w >= 0 && n < empty - 1; w--)
+                            if(pool & (1ULL << w)){ hi += w + 1; n++; }
                     }
 
-                    // reset possvals
-                    resetPoss(possvals);
+                    if(n < empty - 1 || rest < lo || rest > hi){
+                        cand[c] &= ~(1ULL << v);
+                        changed = true;
+                    }
                 }
+                if(!cand[c]) return false;
+            }
+        }
+    }
 
-        // reset possvals
-        resetPoss(possvals);
-    }while(!victory() && backup != board);
+    return true;
+}
 
-    return victory();
+// Depth-first search over the candidates of the most constrained cell
+template<typename T>
+bool Puzzle<T>::search(vector<mask_t>& cand, vector<int>& vals){
+    if(!propagate(cand, vals)) return false;
+
+    int best = -1, fewest = dimension + 1;
+    for(unsigned int c = 0; c < vals.size(); c++){
+        int n = __builtin_popcountll(cand[c]);
+        if(vals[c] < 0 && n < fewest){
+            best = c;
+            fewest = n;
+        }
+    }
+    if(best < 0) return true;
+
+    for(mask_t left = cand[best]; left; left &= left - 1){
+        vector<mask_t> trycand = cand;
+        vector<int> tryvals = vals;
+        if(place(trycand, tryvals, best, __builtin_ctzll(left)) && search(trycand, tryvals)){
+            cand = trycand;
+            vals = tryvals;
+            return true;
+        }
+    }
+    return false;
 }
 
 
@@ -438,7 +778,9 @@ void Puzzle<T>::play(void){
 
             // Prompt for further input if invalid
             if(check_char) cout << boost::format("Please enter a %s\n") % (word?"letter":"number");
-            if(!check_pos) cout << boost::format("There's already a %c in that %s %s %s\n") % (word?usrIn:((char)(usrIn+48))) % (uniqRow?"":"row") % (uniqCol?"":"col") % (uniqSub?"":"grid");
+            if(!check_pos && uniqRow && uniqCol && uniqSub)
+                cout << boost::format("That %c conflicts with a diagonal or cage\n") % (word?usrIn:((char)(usrIn+48)));
+            else if(!check_pos) cout << boost::format("There's already a %c in that %s %s %s\n") % (word?usrIn:((char)(usrIn+48))) % (uniqRow?"":"row") % (uniqCol?"":"col") % (uniqSub?"":"grid");
 
         }while(check_char || (!allowDups && !check_pos));
 
@@ -455,22 +797,35 @@ void Puzzle<T>::play(void){
 // Determine if the board has been solved
 template<typename T>
 bool Puzzle<T>::victory(void){
-    
-    vector<T> tmp = getRow(0);
-    has0s(tmp);
-
-    // Check rows
-    for(int i = 0; i < dimension; i++)
-        if(!isunique(board[i]) || has0s(board[i])) return false;
-
-    // Check cols
-    for(int i = 0; i < dimension; i++){
-        vector<T> tmp = getCol(i); //assign col vals to tmp vector
-        if(!isunique(tmp) || has0s(tmp)) return false;
+    if(!valid) return false;
+    if(stale) buildUnits();
+
+    // Every cell holds a legal value
+    for(int c = 0; c < dimension * dimension; c++)
+        if(valIndex(board[c / dimension][c % dimension]) < 0) return false;
+
+    // Check every unit (rows, cols, regions, diagonals) for repeats
+    for(unsigned int u = 0; u + 1 < unitstart.size(); u++){
+        mask_t seen = 0;
+        for(int i = unitstart[u]; i < unitstart[u + 1]; i++){
+            mask_t bit = 1ULL << valIndex(board[unitcells[i] / dimension][unitcells[i] % dimension]);
+            if(seen & bit) return false;
+            seen |= bit;
+        }
     }
 
-    // Rows and cols being ALL correct is logically equivalent
-    // to the sub-grids being solved.
+    // Check cages: distinct values that add up to the cage sum
+    for(unsigned int k = 0; k < cagesums.size(); k++){
+        mask_t seen = 0;
+        int sum = 0;
+        for(int i = cagestart[k]; i < cagestart[k + 1]; i++){
+            int v = valIndex(board[cagecells[i] / dimension][cagecells[i] % dimension]);
+            if(seen & (1ULL << v)) return false;
+            seen |= 1ULL << v;
+            sum += v + 1;
+        }
+        if(sum != cagesums[k]) return false;
+    }
 
     return true;
 }
@@ -486,11 +841,11 @@ bool Puzzle<T>::has0s(vector<T> vec_in){
 
 template<typename T>
 bool Puzzle<T>::check3x3(T elem, int x, int y){
-    while(x % 3 != 0) x--;
-    while(y % 3 != 0) y--;
-    for(int i = x; i < (x + 3); i++)
-        for(int j = y; j < (y + 3); j++)
-            if(board[i][j] == elem) return false;
+    if(stale) buildUnits();
+    int region = regions[x * dimension + y];
+    if(region < 0) return true;
+    for(int c = 0; c < dimension * dimension; c++)
+        if(regions[c] == region && board[c / dimension][c % dimension] == elem) return false;
     return true;
 }
 
@@ -511,10 +866,12 @@ vector<T> Puzzle<T>::getCol(int i){
 
 template<typename T>
 bool Puzzle<T>::checkpos(T elem, int x, int y){
-    return
-        !VecFunc::vecHas(getRow(x), elem) &&
-        !VecFunc::vecHas(getCol(y), elem) &&
-        check3x3(elem, x, y);
+    if(stale) buildUnits();
+    int cell = x * dimension + y;
+    if(board[x][y] == elem) return false;
+    for(int p = peerstart[cell]; p < peerstart[cell + 1]; p++)
+        if(board[peercells[p] / dimension][peercells[p] % dimension] == elem) return false;
+    return true;
 }
 
 template<typename T>
@@ -0,0 +1,58 @@
+/* bench.cpp
+ *
+ * Benchmark driver for the Sudoku solver. Loads each board
+ * once, then times repeated solves of a fresh copy. Prints
+ * one line per board and a total line in microseconds, which
+ * bench.sh compares across the build variants.
+ *
+ * Usage: bench.out reps board1.txt [board2.txt ...]
+ *
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include "Puzzle.hpp"
+using namespace std;
+
+int main(int argc, char *argv[]){
+
+    int reps = argc < 3 ? 0 : atoi(argv[1]);
+    if(reps < 1){
+        cout << "Usage: " << argv[0] << " reps board1.txt [board2.txt ...]\n";
+        return 1;
+    }
+
+    double total = 0;
+    bool allsolved = true;
+
+    for(int f = 2; f < argc; f++){
+        // A board that fails to open must not be timed as an empty solve
+        ifstream check(argv[f]);
+        if(!check.good()){
+            cout << boost::format("Error: cannot read %s\n") % argv[f];
+            return 1;
+        }
+        check.close();
+
+        Puzzle<int> orig(argv[f]);
+        bool solved = true;
+
+        // Only the solve itself is timed; the copy is cheap next to it
+        chrono::duration<double, micro> elapsed(0);
+        for(int r = 0; r < reps; r++){
+            Puzzle<int> puz = orig;
+            auto start = chrono::steady_clock::now();
+            solved = puz.solve();
+            elapsed += chrono::steady_clock::now() - start;
+        }
+
+        if(!solved) allsolved = false;
+        total += elapsed.count();
+        cout << boost::format("%-28s %12.1f us/solve %s\n")
+            % argv[f] % (elapsed.count() / reps) % (solved?"":"(unsolved)");
+    }
+
+    cout << boost::format("total %.1f us\n") % (total / reps);
+
+    return allsolved ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+#
+# bench.sh
+#
+# Runs each benchmark binary over the same boards and reports
+# its time per pass and speedup relative to the first binary.
+#
+# Usage: bench.sh reps "board1.txt board2.txt ..." baseline.out other.out ...
+#
+
+reps=$1
+boards=$2
+shift 2
+
+base=""
+printf "%-20s %14s %10s\n" "variant" "us/pass" "speedup"
+for bin in "$@"; do
+    if ! out=$(./$bin $reps $boards); then
+        echo "$bin: failed to solve the boards" >&2
+        exit 1
+    fi
+    total=$(echo "$out" | awk '/^total/ { print $2 }')
+    [ -z "$base" ] && base=$total
+    printf "%-20s %14.1f %9.2fx\n" "$bin" "$total" \
+        "$(echo "$base $total" | awk '{ print $1 / $2 }')"
+done